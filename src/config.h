@@ -0,0 +1,62 @@
+/*
+**------------------------------------------------------------------------------
+** Build time configuration shared by all modules
+**------------------------------------------------------------------------------
+*/
+
+#ifndef _CONFIG_H_
+#define _CONFIG_H_
+
+#define PORTRAIT    0
+#define LANDSCAPE   1
+
+#define SCREEN_WIDTH         128        // OLED display width, in pixels
+#define SCREEN_HEIGHT        32         // OLED display height, in pixels
+
+
+#define _SESSIONCOUNTER_
+#define _THERMOMETER_
+//#define _INVERTED_DISPLAY_
+#define _ARROWINDICATORS_
+#define ORIENTATION LANDSCAPE
+
+//Gear detection: one input per gear, or one analog gear position sensor read
+//through the ADS1115
+#define GEAR_SWITCHES   0
+#define GEAR_SENSOR     1
+#define GEARINPUT       GEAR_SWITCHES
+
+//Main panel transport. SPI uses hardware SPI with DMA bursts on nRF52.
+#define TRANSPORT_I2C   0
+#define TRANSPORT_SPI   1
+#define DISPLAY_TRANSPORT TRANSPORT_I2C
+#define SPI_BITRATE         8000000UL
+//Times full frame pushes at startup and prints them over Serial
+//#define _TRANSPORT_BENCHMARK_
+
+//Second SSD1306 on the other I2C bus, either mirroring the main panel or
+//showing a stats screen
+//#define _SECOND_DISPLAY_
+#define SECOND_MIRROR   0
+#define SECOND_STATS    1
+#define SECOND_MODE     SECOND_STATS
+//Puts the main panel on Wire1 so the ADC shares Wire with the quieter panel
+//#define _ADC_ON_QUIET_BUS_
+
+//RPM from an ignition/tach pulse, captured by a hardware timer.
+//ATmega328P: ICP1 (D8), Primo Core: RPM_PIN
+//#define _RPMINPUT_
+#define RPM_PIN             24U         // INT4, only used on nRF52
+#define PULSES_PER_REV      1U
+#define RPM_AVERAGE         4U          // periods averaged in the ISR
+#define RPM_LIMIT           20000U      // faster pulses are treated as noise
+
+//Streams the main panel over Serial, see tools/mirrorview.py
+//#define _SERIALMIRROR_
+#define MIRRORDELAY         5U          // loop passes between frame checks
+#define MIRROR_KEYFRAME     100U        // frame checks between full frames
+
+//Time and estimated charge per power state, sent over Serial on 'e'
+//#define _ENERGYMETER_
+
+#endif
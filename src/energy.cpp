@@ -0,0 +1,184 @@
+/*
+**------------------------------------------------------------------------------
+** Energy:
+**
+** Accumulates the time each power relevant part spends on and off and turns
+** it into an estimated charge with a per board current table.
+**
+** Time stamps are passed in (micros() on the device), so the module also
+** runs on a host with a virtual clock, see tools/energysim.cpp.
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** References
+**------------------------------------------------------------------------------
+*/
+#include <stdint.h>
+#include <config.h>
+#include <energy.h>
+
+#ifdef _ENERGYMETER_
+
+/*
+**------------------------------------------------------------------------------
+** Types
+**------------------------------------------------------------------------------
+*/
+typedef struct
+{
+    uint16_t offUa;
+    uint16_t onUa;
+}draw_t;
+
+/*
+**------------------------------------------------------------------------------
+** Constants
+**------------------------------------------------------------------------------
+*/
+//Estimated currents in uA, measure your own board for real numbers. delay()
+//busy waits on both cores, so the MCU draws the same when idle.
+#if defined(__AVR__)
+//ATmega328P at 16 MHz, 5 V
+const draw_t draw[ENERGY_DOMAINS] =
+{
+    { 10, 12000 },                      // SSD1306 128x32, per panel
+    { 12000, 12000 },                   // MCU
+    { 1, 200 },                         // ADS1115
+    { 0, 1000 },                        // I2C pull-ups while transferring
+};
+#else
+//Primo Core (nRF52832 at 64 MHz), 3.3 V. Also used by host builds.
+const draw_t draw[ENERGY_DOMAINS] =
+{
+    { 10, 8000 },                       // SSD1306 128x32, per panel
+    { 4000, 4000 },                     // MCU
+    { 1, 150 },                         // ADS1115
+    { 0, 700 },                         // I2C pull-ups while transferring
+};
+#endif
+
+/*
+**------------------------------------------------------------------------------
+** Locals
+**------------------------------------------------------------------------------
+*/
+static uint64_t spent[ENERGY_DOMAINS][2];
+static uint32_t since[ENERGY_DOMAINS];
+static uint8_t state[ENERGY_DOMAINS];
+static uint8_t panelCount = 1;
+
+/*
+**------------------------------------------------------------------------------
+** Functions
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** energyBegin:
+**
+** Clears the counters. The panels start on and the MCU active, everything
+** else off.
+**------------------------------------------------------------------------------
+*/
+void energyBegin(uint32_t now, uint8_t panels)
+{
+    uint8_t i;
+
+    for(i = 0 ; i < ENERGY_DOMAINS ; i++)
+    {
+        spent[i][0] = 0;
+        spent[i][1] = 0;
+        since[i] = now;
+        state[i] = false;
+    }
+    state[ENERGY_PANEL] = true;
+    state[ENERGY_MCU] = true;
+    panelCount = panels;
+}
+
+/*
+**------------------------------------------------------------------------------
+** energySet:
+**
+** Records a state change, the time in the previous state is added up
+**------------------------------------------------------------------------------
+*/
+void energySet(uint8_t domain, uint8_t on, uint32_t now)
+{
+    on = on ? 1 : 0;
+    if(state[domain] == on)
+    {
+        return;
+    }
+
+    spent[domain][state[domain]] += (uint32_t)(now - since[domain]);
+    since[domain] = now;
+    state[domain] = on;
+}
+
+/*
+**------------------------------------------------------------------------------
+** energyUpdate:
+**
+** Brings all counters up to now without changing any state. Has to be called
+** more often than the time stamps wrap (71 minutes with micros()).
+**------------------------------------------------------------------------------
+*/
+void energyUpdate(uint32_t now)
+{
+    uint8_t i;
+
+    for(i = 0 ; i < ENERGY_DOMAINS ; i++)
+    {
+        spent[i][state[i]] += (uint32_t)(now - since[i]);
+        since[i] = now;
+    }
+}
+
+/*
+**------------------------------------------------------------------------------
+** energySeconds:
+**
+** Time spent in a state, as of the last update
+**------------------------------------------------------------------------------
+*/
+float energySeconds(uint8_t domain, uint8_t on)
+{
+    return spent[domain][on ? 1 : 0] / 1e6;
+}
+
+/*
+**------------------------------------------------------------------------------
+** energyCharge:
+**
+** Estimated charge used by a part in mAh, as of the last update
+**------------------------------------------------------------------------------
+*/
+float energyCharge(uint8_t domain)
+{
+    float uAs;
+
+    uAs = energySeconds(domain, false) * draw[domain].offUa +
+          energySeconds(domain, true) * draw[domain].onUa;
+    if(domain == ENERGY_PANEL)
+    {
+        uAs *= panelCount;
+    }
+
+    return uAs / 3600.0 / 1000.0;
+}
+
+/*
+**------------------------------------------------------------------------------
+** energyElapsed:
+**
+** Seconds accounted for since energyBegin()
+**------------------------------------------------------------------------------
+*/
+float energyElapsed(void)
+{
+    return energySeconds(ENERGY_MCU, false) + energySeconds(ENERGY_MCU, true);
+}
+
+#endif
@@ -0,0 +1,25 @@
+/*
+**------------------------------------------------------------------------------
+** Energy accounting per power state
+**------------------------------------------------------------------------------
+*/
+
+#ifndef _ENERGY_H_
+#define _ENERGY_H_
+
+#include <stdint.h>
+
+#define ENERGY_PANEL        0           // on: wakeDisplay(), off: sleepDisplay()
+#define ENERGY_MCU          1           // on: running, off: in delay()
+#define ENERGY_ADC          2           // on: converting
+#define ENERGY_BUS          3           // on: I2C transfer going on
+#define ENERGY_DOMAINS      4
+
+void energyBegin(uint32_t now, uint8_t panels);
+void energySet(uint8_t domain, uint8_t on, uint32_t now);
+void energyUpdate(uint32_t now);
+float energySeconds(uint8_t domain, uint8_t on);
+float energyCharge(uint8_t domain);
+float energyElapsed(void);
+
+#endif
@@ -0,0 +1,94 @@
+/*
+**------------------------------------------------------------------------------
+** Gear sensor:
+**
+** Maps the voltage of an analog gear position sensor to a gear. Has no
+** hardware access, so it also builds on a PC, see tools/gearsim.cpp.
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** References
+**------------------------------------------------------------------------------
+*/
+#include <stdint.h>
+#include <gearsensor.h>
+
+/*
+**------------------------------------------------------------------------------
+** Constants
+**------------------------------------------------------------------------------
+*/
+//Gear position sensor voltage bands in mV, in the same order as gears[]
+const band_t gearBands[GEARSENSOR_GEARS] =
+{
+    { 1200, 1560 },
+    { 4800, 5300 },
+    { 1560, 2130 },
+    { 2130, 2860 },
+    { 2860, 3660 },
+    { 3660, 4350 },
+    { 4350, 4800 }
+};
+
+#define GEARSENSOR_HYST     60U         // mV the current band is widened by
+#define GEARSENSOR_DEBOUNCE 3U          // samples a new gear has to hold
+
+/*
+**------------------------------------------------------------------------------
+** Functions
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** classifyGear:
+**
+** Maps a sensor voltage to a gear. The current gear is kept while the voltage
+** stays in its band plus some hysteresis, a new gear has to be seen for a few
+** samples in a row. Voltages between bands keep the current gear.
+**------------------------------------------------------------------------------
+*/
+int16_t classifyGear(uint16_t mv)
+{
+    static int16_t current = -1;
+    static int16_t candidate = -1;
+    static uint8_t count = 0;
+    int16_t gear;
+
+    if((current >= 0) &&
+       (mv + GEARSENSOR_HYST >= gearBands[current].lo) &&
+       (mv <= gearBands[current].hi + GEARSENSOR_HYST))
+    {
+        candidate = current;
+        count = 0;
+        return current;
+    }
+
+    for(gear = 0 ; gear < (int16_t)GEARSENSOR_GEARS ; gear++)
+    {
+        if((mv >= gearBands[gear].lo) && (mv < gearBands[gear].hi))
+        {
+            break;
+        }
+    }
+    if(gear >= (int16_t)GEARSENSOR_GEARS)
+    {
+        return current;
+    }
+
+    if(gear == candidate)
+    {
+        count++;
+    }
+    else
+    {
+        candidate = gear;
+        count = 1;
+    }
+    if(count >= GEARSENSOR_DEBOUNCE)
+    {
+        current = gear;
+    }
+
+    return current;
+}
@@ -0,0 +1,24 @@
+/*
+**------------------------------------------------------------------------------
+** Gear position sensor voltage classification
+**------------------------------------------------------------------------------
+*/
+
+#ifndef _GEARSENSOR_H_
+#define _GEARSENSOR_H_
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint16_t lo;
+    uint16_t hi;
+}band_t;
+
+#define GEARSENSOR_GEARS    7U
+
+extern const band_t gearBands[GEARSENSOR_GEARS];
+
+int16_t classifyGear(uint16_t mv);
+
+#endif
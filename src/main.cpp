@@ -13,27 +13,18 @@
 */
 #include <Arduino.h>
 #include <Wire.h>
+#include <SPI.h>
 #include <Adafruit_SSD1306.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_ADS1015.h>
 #include <fonts/FreeSansBold24pt7b.h>
 #include <stdint.h>
 #include <bitmaps.h>
-
-/*
-**------------------------------------------------------------------------------
-** Macros
-**------------------------------------------------------------------------------
-*/
-#define PORTRAIT    0
-#define LANDSCAPE   1
-
-
-#define _SESSIONCOUNTER_
-#define _THERMOMETER_
-//#define _INVERTED_DISPLAY_
-#define _ARROWINDICATORS_
-#define ORIENTATION LANDSCAPE
+#include <config.h>
+#include <rpm.h>
+#include <mirror.h>
+#include <energy.h>
+#include <gearsensor.h>
 
 /*
 **------------------------------------------------------------------------------
@@ -47,39 +38,85 @@ typedef struct
     uint8_t xOffset;
 }indicator_t;
 
+typedef struct
+{
+    Adafruit_SSD1306* display;
+    TwoWire* bus;
+    uint8_t dirty;
+}panel_t;
+
 /*
 **------------------------------------------------------------------------------
 ** Constants
 **------------------------------------------------------------------------------
 */
 
-#define SCREEN_WIDTH         128        // OLED display width, in pixels
-#define SCREEN_HEIGHT        32         // OLED display height, in pixels
+#define SCREEN_ADDRESS       0x3c
+
+#if (DISPLAY_TRANSPORT == TRANSPORT_SPI) && defined(NRF52)
+//MOSI, MISO, SCK and SS take D4..D7 on the Primo Core
+#define SPI_CS_PIN           7
+#define SPI_DC_PIN           0
+#define SPI_RST_PIN          1
+#define GEAR1_PIN            2
+#define GEARN_PIN            3
+#define GEAR2_PIN            8
+#define GEAR3_PIN            9
+#define GEAR4_PIN            20
+#define GEAR5_PIN            21
+#define GEAR6_PIN            22
+#else
+#define SPI_CS_PIN           10
+#define SPI_DC_PIN           A0
+#define SPI_RST_PIN          A1
+#define GEAR1_PIN            2
+#define GEARN_PIN            3
+#define GEAR2_PIN            4
+#define GEAR3_PIN            5
+#define GEAR4_PIN            6
+#define GEAR5_PIN            7
+//ICP1 is hardwired to D8 on the ATmega328P
+#if defined(_RPMINPUT_) && defined(__AVR__)
+#define GEAR6_PIN            9
+#else
+#define GEAR6_PIN            8
+#endif
+#endif
 
 #if (ORIENTATION == PORTRAIT)
 const indicator_t gears[7] =
 {
-    { "1", 2, 4 },
-    { "N", 3, 0 },
-    { "2", 4, 4 },
-    { "3", 5, 4 },
-    { "4", 6, 4 },
-    { "5", 7, 4 },
-    { "6", 8, 4 }
+    { "1", GEAR1_PIN, 4 },
+    { "N", GEARN_PIN, 0 },
+    { "2", GEAR2_PIN, 4 },
+    { "3", GEAR3_PIN, 4 },
+    { "4", GEAR4_PIN, 4 },
+    { "5", GEAR5_PIN, 4 },
+    { "6", GEAR6_PIN, 4 }
 };
 #elif (ORIENTATION == LANDSCAPE)
 const indicator_t gears[7] =
 {
-    { "1", 2, 64 },
-    { "N", 3, 60 },
-    { "2", 4, 64 },
-    { "3", 5, 64 },
-    { "4", 6, 64 },
-    { "5", 7, 64 },
-    { "6", 8, 64 }
+    { "1", GEAR1_PIN, 64 },
+    { "N", GEARN_PIN, 60 },
+    { "2", GEAR2_PIN, 64 },
+    { "3", GEAR3_PIN, 64 },
+    { "4", GEAR4_PIN, 64 },
+    { "5", GEAR5_PIN, 64 },
+    { "6", GEAR6_PIN, 64 }
 };
 #endif
 
+#if (GEARINPUT == GEAR_SENSOR)
+#define GEARSENSOR_CHANNEL  1U
+//ADS1115 config: single ended on the channel, +-6.144 V, continuous, 860 SPS,
+//comparator off. The library only has the ADS1015 data rates, and its
+//comparator mode runs the ADS1115 at 128 SPS.
+#define GEARSENSOR_CONFIG   (0x4000 | (GEARSENSOR_CHANNEL << 12) | 0x00e3)
+#define ADS_REG_CONVERSION  0x00
+#define ADS_REG_CONFIG      0x01
+#endif
+
 const int16_t ledPin = LED_BUILTIN;
 
 #if (ORIENTATION == PORTRAIT)
@@ -110,6 +147,12 @@ const int16_t upXPos = 16;
 const int16_t upYPos = yBasePos + 16;
 const int16_t dnXPos = 0;
 const int16_t dnYPos = yBasePos + 16;
+#elif (ORIENTATION == LANDSCAPE) && defined(_RPMINPUT_)
+//Make room for the shift light
+const int16_t upXPos = 94;
+const int16_t upYPos = yBasePos - 33;
+const int16_t dnXPos = 94;
+const int16_t dnYPos = yBasePos - 15;
 #elif (ORIENTATION == LANDSCAPE)
 const int16_t upXPos = 100;
 const int16_t upYPos = yBasePos - 33;
@@ -118,8 +161,81 @@ const int16_t dnYPos = yBasePos - 15;
 #endif
 #endif
 
+#ifdef _RPMINPUT_
+#define RPMFRAMEDELAY       5U          // loop passes between bar updates
+#define RPM_MAX             12000U      // full bar
+#define SHIFTRPM            10500U      // bar flashes from here on
+#define RPM_SEGMENTS        8U
+//The bar region is the last 16 physical columns in both orientations, so it
+//can be pushed on its own
+#define RPM_COLUMN          (SCREEN_WIDTH - 16)
+#if (ORIENTATION == PORTRAIT)
+const int16_t rpmTextYPos = 7;
+#elif (ORIENTATION == LANDSCAPE)
+const int16_t rpmBarXPos = RPM_COLUMN + 12;
+#endif
+#endif
+
 #define SLEEPDELAY          1000U
 
+#define ADC_ADDRESS         0x48
+
+#if defined(_SECOND_DISPLAY_) && (!defined(WIRE_INTERFACES_COUNT) || (WIRE_INTERFACES_COUNT < 2))
+#error "_SECOND_DISPLAY_ needs a board with two I2C interfaces"
+#endif
+
+#if defined(_SECOND_DISPLAY_) && !defined(NRF52)
+#error "_SECOND_DISPLAY_ pushes both panels with the nRF52 TWIM peripherals"
+#endif
+
+#if defined(_ADC_ON_QUIET_BUS_) && (!defined(WIRE_INTERFACES_COUNT) || (WIRE_INTERFACES_COUNT < 2))
+#error "_ADC_ON_QUIET_BUS_ needs a board with two I2C interfaces"
+#endif
+
+//The nRF52832 SPI0 and TWI0 (Wire1) are the same peripheral
+#if defined(_SECOND_DISPLAY_) && (DISPLAY_TRANSPORT == TRANSPORT_SPI) && defined(NRF52)
+#error "_SECOND_DISPLAY_ can't be used with the SPI transport on nRF52"
+#endif
+
+//These print plain text, which would end up in the middle of the mirror stream
+#if defined(_SERIALMIRROR_) && defined(_ENERGYMETER_)
+#error "_ENERGYMETER_ and _SERIALMIRROR_ both use Serial"
+#endif
+#if defined(_SERIALMIRROR_) && defined(_TRANSPORT_BENCHMARK_)
+#error "_TRANSPORT_BENCHMARK_ and _SERIALMIRROR_ both use Serial"
+#endif
+
+#ifdef _TRANSPORT_BENCHMARK_
+#define BENCHMARKPUSHES     50U
+#endif
+
+#ifdef _ENERGYMETER_
+#define ENERGY(domain, on)  energySet(domain, on, micros())
+#else
+#define ENERGY(domain, on)
+#endif
+
+//Panel commands only load the I2C bus when the panels are on I2C
+#if (DISPLAY_TRANSPORT == TRANSPORT_I2C)
+#define PANELBUS(on)        ENERGY(ENERGY_BUS, on)
+#else
+#define PANELBUS(on)
+#endif
+
+//The ADS1015 library always talks over Wire, so the ADC is moved by moving
+//the main panel away from it instead
+#ifdef _ADC_ON_QUIET_BUS_
+#define MAIN_BUS            Wire1
+#define SECOND_BUS          Wire
+#else
+#define MAIN_BUS            Wire
+#define SECOND_BUS          Wire1
+#endif
+
+//TWIM instances behind Wire and Wire1 in the nRF5 core (Wire_nRF52.cpp)
+#define WIRE_TWIM           NRF_TWIM1
+#define WIRE1_TWIM          NRF_TWIM0
+
 /*
 **------------------------------------------------------------------------------
 ** Function prototypes
@@ -127,17 +243,47 @@ const int16_t dnYPos = yBasePos - 15;
 */
 void drawGearInfo(int16_t);
 float measureT(void);
+void markDirty(uint16_t);
+void pushPanelColumns(panel_t*, uint8_t, uint8_t);
+void startGearSensor(void);
 
 /*
 **------------------------------------------------------------------------------
 ** Locals
 **------------------------------------------------------------------------------
 */
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, -1, 200000, 200000);
-Adafruit_ADS1115 adc(0x48);
+#if (DISPLAY_TRANSPORT == TRANSPORT_I2C)
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &MAIN_BUS, -1, 200000, 200000);
+#elif (DISPLAY_TRANSPORT == TRANSPORT_SPI)
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &SPI, SPI_DC_PIN, SPI_RST_PIN, SPI_CS_PIN, SPI_BITRATE);
+#endif
+#ifdef _SECOND_DISPLAY_
+Adafruit_SSD1306 display2(SCREEN_WIDTH, SCREEN_HEIGHT, &SECOND_BUS, -1, 200000, 200000);
+#endif
+static panel_t panels[] =
+{
+#if (DISPLAY_TRANSPORT == TRANSPORT_I2C)
+    { &display, &MAIN_BUS, false },
+#elif (DISPLAY_TRANSPORT == TRANSPORT_SPI)
+    { &display, NULL, false },
+#endif
+#ifdef _SECOND_DISPLAY_
+    { &display2, &SECOND_BUS, false },
+#endif
+};
+#define PANEL_COUNT         (sizeof(panels)/sizeof(panel_t))
+#define MAIN_PANEL          0
+#define SECOND_PANEL        1
+Adafruit_ADS1115 adc(ADC_ADDRESS);
 static uint32_t changeCounter = 0;
 static float temperature = 12.34;
 static int16_t firstRun = true;
+#if (GEARINPUT == GEAR_SENSOR)
+static int16_t sensorGear = -1;
+#endif
+#ifdef _RPMINPUT_
+static uint16_t rpm = 0;
+#endif
 
 /*
 **------------------------------------------------------------------------------
@@ -153,7 +299,10 @@ static int16_t firstRun = true;
 */
 void sleepDisplay(Adafruit_SSD1306* display)
 {
+    PANELBUS(true);
     display->ssd1306_command(SSD1306_DISPLAYOFF);
+    PANELBUS(false);
+    ENERGY(ENERGY_PANEL, false);
 }
 
 /*
@@ -165,7 +314,331 @@ void sleepDisplay(Adafruit_SSD1306* display)
 */
 void wakeDisplay(Adafruit_SSD1306* display)
 {
+    PANELBUS(true);
     display->ssd1306_command(SSD1306_DISPLAYON);
+    PANELBUS(false);
+    ENERGY(ENERGY_PANEL, true);
+}
+
+/*
+**------------------------------------------------------------------------------
+** markDirty:
+**
+** Flags a panel as needing a push of its frame buffer
+**------------------------------------------------------------------------------
+*/
+void markDirty(uint16_t panel)
+{
+    panels[panel].dirty = true;
+#if defined(_SECOND_DISPLAY_) && (SECOND_MODE == SECOND_MIRROR)
+    if(panel == MAIN_PANEL)
+    {
+        panels[SECOND_PANEL].dirty = true;
+    }
+#endif
+}
+
+#ifdef _SECOND_DISPLAY_
+/*
+**------------------------------------------------------------------------------
+** pushPanelsTogether:
+**
+** Pushes all dirty panels at once, page by page, with the TWIM of each bus
+** doing its transfer by EasyDMA at the same time. The loop only blocks for
+** the slower of the two instead of both in turn. Only the address window
+** goes through the library.
+**------------------------------------------------------------------------------
+*/
+void pushPanelsTogether(void)
+{
+    static uint8_t stage[PANEL_COUNT][SCREEN_WIDTH + 1];
+    NRF_TWIM_Type* twim;
+    uint8_t page;
+    uint16_t i;
+
+    ENERGY(ENERGY_BUS, true);
+    for(i = 0 ; i < PANEL_COUNT ; i++)
+    {
+        if(panels[i].dirty)
+        {
+            panels[i].display->ssd1306_command(SSD1306_PAGEADDR);
+            panels[i].display->ssd1306_command(0);
+            panels[i].display->ssd1306_command(SCREEN_HEIGHT / 8 - 1);
+            panels[i].display->ssd1306_command(SSD1306_COLUMNADDR);
+            panels[i].display->ssd1306_command(0);
+            panels[i].display->ssd1306_command(SCREEN_WIDTH - 1);
+        }
+    }
+
+    for(page = 0 ; page < SCREEN_HEIGHT / 8 ; page++)
+    {
+        //Start all transfers...
+        for(i = 0 ; i < PANEL_COUNT ; i++)
+        {
+            if(!panels[i].dirty)
+            {
+                continue;
+            }
+            twim = (panels[i].bus == &Wire) ? WIRE_TWIM : WIRE1_TWIM;
+
+            stage[i][0] = 0x40;
+            memcpy(&stage[i][1], panels[i].display->getBuffer() + page * SCREEN_WIDTH, SCREEN_WIDTH);
+
+            twim->ADDRESS = SCREEN_ADDRESS;
+            twim->TXD.PTR = (uint32_t)stage[i];
+            twim->TXD.MAXCNT = SCREEN_WIDTH + 1;
+            twim->SHORTS = TWIM_SHORTS_LASTTX_STOP_Msk;
+            twim->EVENTS_STOPPED = 0;
+            twim->EVENTS_ERROR = 0;
+            twim->TASKS_STARTTX = 1;
+        }
+
+        //...then wait for all of them
+        for(i = 0 ; i < PANEL_COUNT ; i++)
+        {
+            if(!panels[i].dirty)
+            {
+                continue;
+            }
+            twim = (panels[i].bus == &Wire) ? WIRE_TWIM : WIRE1_TWIM;
+
+            while(!twim->EVENTS_STOPPED)
+            {
+                if(twim->EVENTS_ERROR)
+                {
+                    twim->EVENTS_ERROR = 0;
+                    twim->ERRORSRC = twim->ERRORSRC;    // write 1 to clear
+                    twim->TASKS_STOP = 1;
+                }
+            }
+
+            //TwoWire waits on these events and only clears them afterwards,
+            //so leave the TWIM as it found it
+            twim->EVENTS_STOPPED = 0;
+            twim->EVENTS_LASTTX = 0;
+            twim->EVENTS_TXSTARTED = 0;
+            twim->SHORTS = 0;
+        }
+    }
+    ENERGY(ENERGY_BUS, false);
+
+    for(i = 0 ; i < PANEL_COUNT ; i++)
+    {
+        panels[i].dirty = false;
+    }
+}
+#endif
+
+/*
+**------------------------------------------------------------------------------
+** flushPanels:
+**
+** Pushes the frame buffer of every dirty panel
+**------------------------------------------------------------------------------
+*/
+void flushPanels(void)
+{
+#ifdef _SECOND_DISPLAY_
+#if (SECOND_MODE == SECOND_MIRROR)
+    if(panels[SECOND_PANEL].dirty)
+    {
+        memcpy(display2.getBuffer(), display.getBuffer(), SCREEN_WIDTH * SCREEN_HEIGHT / 8);
+    }
+#endif
+    pushPanelsTogether();
+#else
+    panel_t* panel = &panels[MAIN_PANEL];
+
+    if(!panel->dirty)
+    {
+        return;
+    }
+    panel->dirty = false;
+
+    if(panel->bus)
+    {
+        ENERGY(ENERGY_BUS, true);
+        panel->display->display();
+        ENERGY(ENERGY_BUS, false);
+    }
+    else
+    {
+        pushPanelColumns(panel, 0, SCREEN_WIDTH - 1);
+    }
+#endif
+}
+
+#if (DISPLAY_TRANSPORT == TRANSPORT_SPI)
+/*
+**------------------------------------------------------------------------------
+** spiBurst:
+**
+** Sends display data in one chip select. On nRF52 the SPI0 instance behind
+** SPI is switched to its EasyDMA (SPIM) mode for the burst, elsewhere the
+** bytes go through a scratch buffer since SPI.transfer() overwrites them.
+**------------------------------------------------------------------------------
+*/
+void spiBurst(const uint8_t* data, uint16_t count)
+{
+#if defined(NRF52)
+#define DMACHUNK            255U        // TXD.MAXCNT is 8 bit on the nRF52832
+    uint16_t n;
+#else
+#define SPICHUNK            32U
+    static uint8_t scratch[SPICHUNK];
+    uint16_t n;
+#endif
+
+    SPI.beginTransaction(SPISettings(SPI_BITRATE, MSBFIRST, SPI_MODE0));
+    digitalWrite(SPI_DC_PIN, HIGH);
+    digitalWrite(SPI_CS_PIN, LOW);
+
+#if defined(NRF52)
+    NRF_SPIM0->ENABLE = (SPIM_ENABLE_ENABLE_Enabled << SPIM_ENABLE_ENABLE_Pos);
+    NRF_SPIM0->RXD.MAXCNT = 0;
+    while(count)
+    {
+        n = (count > DMACHUNK) ? DMACHUNK : count;
+        NRF_SPIM0->TXD.PTR = (uint32_t)data;
+        NRF_SPIM0->TXD.MAXCNT = n;
+        NRF_SPIM0->EVENTS_END = 0;
+        NRF_SPIM0->TASKS_START = 1;
+        while(!NRF_SPIM0->EVENTS_END);
+        data += n;
+        count -= n;
+    }
+    NRF_SPIM0->ENABLE = (SPI_ENABLE_ENABLE_Enabled << SPI_ENABLE_ENABLE_Pos);
+#else
+    while(count)
+    {
+        n = (count > SPICHUNK) ? SPICHUNK : count;
+        memcpy(scratch, data, n);
+        SPI.transfer(scratch, n);
+        data += n;
+        count -= n;
+    }
+#endif
+
+    digitalWrite(SPI_CS_PIN, HIGH);
+    SPI.endTransaction();
+}
+#endif
+
+/*
+**------------------------------------------------------------------------------
+** pushPanelColumns:
+**
+** Pushes physical columns x0..x1 of all pages, leaving the rest of the panel
+** untouched. display() sets the full address window again on the next push.
+**------------------------------------------------------------------------------
+*/
+void pushPanelColumns(panel_t* panel, uint8_t x0, uint8_t x1)
+{
+#define PUSHCHUNK           16U
+    uint8_t* buffer = panel->display->getBuffer();
+    uint8_t page;
+    uint8_t x;
+    uint8_t n;
+
+    if(panel->bus)
+    {
+        ENERGY(ENERGY_BUS, true);
+    }
+    panel->display->ssd1306_command(SSD1306_PAGEADDR);
+    panel->display->ssd1306_command(0);
+    panel->display->ssd1306_command(SCREEN_HEIGHT / 8 - 1);
+    panel->display->ssd1306_command(SSD1306_COLUMNADDR);
+    panel->display->ssd1306_command(x0);
+    panel->display->ssd1306_command(x1);
+
+#if (DISPLAY_TRANSPORT == TRANSPORT_SPI)
+    if(!panel->bus)
+    {
+        //A full width window is one contiguous run of the buffer
+        if((x0 == 0) && (x1 == SCREEN_WIDTH - 1))
+        {
+            spiBurst(buffer, SCREEN_WIDTH * SCREEN_HEIGHT / 8);
+            return;
+        }
+        for(page = 0 ; page < SCREEN_HEIGHT / 8 ; page++)
+        {
+            spiBurst(&buffer[x0 + page * SCREEN_WIDTH], x1 - x0 + 1);
+        }
+        return;
+    }
+#endif
+
+    for(page = 0 ; page < SCREEN_HEIGHT / 8 ; page++)
+    {
+        x = x0;
+        while(x <= x1)
+        {
+            panel->bus->beginTransmission(SCREEN_ADDRESS);
+            panel->bus->write((uint8_t)0x40);
+            for(n = 0 ; (n < PUSHCHUNK) && (x <= x1) ; n++, x++)
+            {
+                panel->bus->write(buffer[x + page * SCREEN_WIDTH]);
+            }
+            panel->bus->endTransmission();
+        }
+    }
+    ENERGY(ENERGY_BUS, false);
+}
+
+#ifdef _TRANSPORT_BENCHMARK_
+/*
+**------------------------------------------------------------------------------
+** benchmarkTransport:
+**
+** Pushes the current main panel frame a number of times and prints the
+** average time per push
+**------------------------------------------------------------------------------
+*/
+void benchmarkTransport(void)
+{
+    uint32_t start;
+    uint16_t i;
+
+    start = micros();
+    for(i = 0 ; i < BENCHMARKPUSHES ; i++)
+    {
+        panels[MAIN_PANEL].dirty = true;
+        flushPanels();
+    }
+#if (DISPLAY_TRANSPORT == TRANSPORT_I2C)
+    Serial.print(F("I2C frame push us: "));
+#elif (DISPLAY_TRANSPORT == TRANSPORT_SPI)
+    Serial.print(F("SPI frame push us: "));
+#endif
+    Serial.println((micros() - start) / BENCHMARKPUSHES);
+}
+#endif
+
+/*
+**------------------------------------------------------------------------------
+** initPanel:
+**
+** Starts a panel and sets up the common text settings
+**------------------------------------------------------------------------------
+*/
+void initPanel(Adafruit_SSD1306* display, uint8_t rotation)
+{
+    if (!display->begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS))  // Address 0x3D for 128x64, 0x3c for 128x32
+    {
+        for (;;)
+        Serial.println(F("Channel display allocation failed")); // Don't proceed, loop forever
+    }
+
+    display->clearDisplay();
+    display->setTextSize(1);      // Normal 1:1 pixel scale
+    display->setTextColor(WHITE); // Draw white text
+    display->setRotation(rotation);
+    display->cp437(true);
+    #ifdef _INVERTED_DISPLAY_
+    display->invertDisplay(true);
+    #endif
+
+    wakeDisplay(display);
 }
 
 /*
@@ -177,7 +650,9 @@ void wakeDisplay(Adafruit_SSD1306* display)
 */
 void setup(void)
 {
-    uint16_t i;
+#ifdef _ENERGYMETER_
+    energyBegin(micros(), PANEL_COUNT);
+#endif
 
     pinMode(ledPin, OUTPUT);
 
@@ -186,33 +661,39 @@ void setup(void)
 
     temperature = measureT();
 
+#ifdef _RPMINPUT_
+    rpmBegin();
+#endif
+
+#if (GEARINPUT == GEAR_SWITCHES)
+    uint16_t i;
+
     for(i = 0 ; i < sizeof(gears)/sizeof(indicator_t) ; i++)
     {
         pinMode(gears[i].pin, INPUT_PULLUP);
     }
+#elif (GEARINPUT == GEAR_SENSOR)
+    startGearSensor();
+#endif
 
-    //Set up the display
-    if (!display.begin(SSD1306_SWITCHCAPVCC, 0x3c))  // Address 0x3D for 128x64, 0x3c for 128x32
-    {
-        for (;;)
-        Serial.println(F("Channel display allocation failed")); // Don't proceed, loop forever
-    }
-
-    display.clearDisplay();
-    display.setTextSize(1);      // Normal 1:1 pixel scale
-    display.setTextColor(WHITE); // Draw white text
+    //Set up the display(s)
 #if (ORIENTATION == PORTRAIT)
-    display.setRotation(1);
+    initPanel(&display, 1);
 #elif (ORIENTATION == LANDSCAPE)
-    display.setRotation(0);
+    initPanel(&display, 0);
+#endif
+#ifdef _SECOND_DISPLAY_
+    //The mirror copies the main frame buffer as is, so rotation only matters
+    //for the stats screen
+    initPanel(&display2, 0);
 #endif
-    display.cp437(true);
-    #ifdef _INVERTED_DISPLAY_
-    display.invertDisplay(true);
-    #endif
 
-    wakeDisplay(&display);
     drawGearInfo(1);
+
+#ifdef _TRANSPORT_BENCHMARK_
+    //Same frame for both transports: gear 1 and the startup temperature
+    benchmarkTransport();
+#endif
 }
 
 #ifdef _SESSIONCOUNTER_
@@ -268,6 +749,136 @@ void drawTemperature(void)
 }
 #endif
 
+#if defined(_SECOND_DISPLAY_) && (SECOND_MODE == SECOND_STATS)
+/*
+**------------------------------------------------------------------------------
+** drawStats:
+**
+** Draws the temperature and session counter on the second display
+**------------------------------------------------------------------------------
+*/
+void drawStats(void)
+{
+    static char str[16];
+
+    display2.clearDisplay();
+    display2.setFont();
+
+    display2.setTextSize(2);
+    display2.setCursor(0, 0);
+    int16_t t = temperature;
+    uint16_t dec = (temperature * 10);
+    dec %= 10;
+    sprintf(str, "% 3d.%1u", t, dec);
+    display2.print(str);
+    display2.drawBitmap(display2.getCursorX() + 1, 0, degIcon, DEGICON_WIDTH, DEGICON_HEIGHT, WHITE);
+
+    display2.setTextSize(1);
+    display2.setCursor(0, 24);
+    sprintf(str, "Shifts % 7lu", changeCounter);
+    display2.print(str);
+
+    markDirty(SECOND_PANEL);
+}
+#endif
+
+#ifdef _RPMINPUT_
+/*
+**------------------------------------------------------------------------------
+** drawRpm:
+**
+** Draws the RPM readout and the segmented shift light bar. Returns true if the
+** bar region was redrawn, which it always is when forced.
+**------------------------------------------------------------------------------
+*/
+int16_t drawRpm(int16_t force)
+{
+    static char str[10];
+    static uint8_t flash = false;
+    static uint8_t lastLit = 0xff;
+    static uint16_t lastShown = 0xffff;
+    uint8_t lit;
+    uint8_t i;
+
+    if(rpm >= SHIFTRPM)
+    {
+        flash = !flash;
+        lit = flash ? RPM_SEGMENTS : 0;
+    }
+    else
+    {
+        lit = ((uint32_t)rpm * RPM_SEGMENTS) / RPM_MAX;
+    }
+
+    if(!force && (lit == lastLit) && (rpm / 100 == lastShown))
+    {
+        return false;
+    }
+    lastLit = lit;
+    lastShown = rpm / 100;
+
+    display.setFont();
+#if (ORIENTATION == PORTRAIT)
+    display.fillRect(0, 0, SCREEN_HEIGHT, SCREEN_WIDTH - RPM_COLUMN, BLACK);
+    for(i = 0 ; i < lit ; i++)
+    {
+        display.fillRect(i * (SCREEN_HEIGHT / RPM_SEGMENTS), 0, SCREEN_HEIGHT / RPM_SEGMENTS - 1, 4, WHITE);
+    }
+    display.setCursor(0, rpmTextYPos);
+    sprintf(str, "% 5u", rpm);
+#elif (ORIENTATION == LANDSCAPE)
+    display.fillRect(RPM_COLUMN, 0, SCREEN_WIDTH - RPM_COLUMN, SCREEN_HEIGHT, BLACK);
+    for(i = 0 ; i < lit ; i++)
+    {
+        display.fillRect(rpmBarXPos, SCREEN_HEIGHT - (i + 1) * (SCREEN_HEIGHT / RPM_SEGMENTS), SCREEN_WIDTH - rpmBarXPos, SCREEN_HEIGHT / RPM_SEGMENTS - 1, WHITE);
+    }
+    //Thousands over hundreds, there's only room for two characters
+    display.setCursor(RPM_COLUMN, 0);
+    sprintf(str, "% 2u", rpm / 1000);
+    display.print(str);
+    display.setCursor(RPM_COLUMN, 10);
+    sprintf(str, ".%1u", (rpm / 100) % 10);
+#endif
+    display.print(str);
+
+    return true;
+}
+
+/*
+**------------------------------------------------------------------------------
+** updateRpm:
+**
+** Pushes only the shift light region, unless a full frame is on its way anyway
+**------------------------------------------------------------------------------
+*/
+void updateRpm(void)
+{
+    if(!drawRpm(false))
+    {
+        return;
+    }
+
+    if(!panels[MAIN_PANEL].dirty)
+    {
+        pushPanelColumns(&panels[MAIN_PANEL], RPM_COLUMN, SCREEN_WIDTH - 1);
+    }
+#if defined(_SECOND_DISPLAY_) && (SECOND_MODE == SECOND_MIRROR)
+    if(!panels[SECOND_PANEL].dirty)
+    {
+        uint8_t page;
+
+        for(page = 0 ; page < SCREEN_HEIGHT / 8 ; page++)
+        {
+            memcpy(display2.getBuffer() + page * SCREEN_WIDTH + RPM_COLUMN,
+                   display.getBuffer() + page * SCREEN_WIDTH + RPM_COLUMN,
+                   SCREEN_WIDTH - RPM_COLUMN);
+        }
+        pushPanelColumns(&panels[SECOND_PANEL], RPM_COLUMN, SCREEN_WIDTH - 1);
+    }
+#endif
+}
+#endif
+
 /*
 **------------------------------------------------------------------------------
 ** drawGearInfo:
@@ -320,7 +931,84 @@ void drawGearInfo(int16_t gear)
     drawTemperature();
 #endif
 
-    display.display();
+#ifdef _RPMINPUT_
+    drawRpm(true);
+#endif
+
+#if defined(_SECOND_DISPLAY_) && (SECOND_MODE == SECOND_STATS)
+    drawStats();
+#endif
+
+    markDirty(MAIN_PANEL);
+}
+
+#if (GEARINPUT == GEAR_SENSOR)
+/*
+**------------------------------------------------------------------------------
+** startGearSensor:
+**
+** Puts the ADC in continuous mode on the sensor channel at 860 SPS and points
+** it at the conversion register, so each sample is a single two byte read at
+** most 1.2 ms old. Has to be called again after any single shot conversion.
+**------------------------------------------------------------------------------
+*/
+void startGearSensor(void)
+{
+    ENERGY(ENERGY_BUS, true);
+    Wire.beginTransmission(ADC_ADDRESS);
+    Wire.write((uint8_t)ADS_REG_CONFIG);
+    Wire.write((uint8_t)(GEARSENSOR_CONFIG >> 8));
+    Wire.write((uint8_t)(GEARSENSOR_CONFIG & 0xff));
+    Wire.endTransmission();
+    ENERGY(ENERGY_ADC, true);
+
+    Wire.beginTransmission(ADC_ADDRESS);
+    Wire.write((uint8_t)ADS_REG_CONVERSION);
+    Wire.endTransmission();
+    ENERGY(ENERGY_BUS, false);
+}
+
+/*
+**------------------------------------------------------------------------------
+** readGearSensor:
+**
+** Returns the latest conversion in mV. getLastConversionResults() waits a full
+** conversion time first, so the register is read directly instead.
+**------------------------------------------------------------------------------
+*/
+uint16_t readGearSensor(void)
+{
+    int16_t raw;
+
+    ENERGY(ENERGY_BUS, true);
+    Wire.requestFrom((uint8_t)ADC_ADDRESS, (uint8_t)2);
+    raw = Wire.read() << 8;
+    raw |= Wire.read();
+    ENERGY(ENERGY_BUS, false);
+
+    if(raw < 0)
+    {
+        return 0;
+    }
+    return ((uint32_t)raw * 3) / 16;        // 0.1875 mV/bit at 2/3 gain
+}
+
+#endif
+
+/*
+**------------------------------------------------------------------------------
+** gearActive:
+**
+** True if the given gear is the one currently selected
+**------------------------------------------------------------------------------
+*/
+int16_t gearActive(int16_t gear)
+{
+#if (GEARINPUT == GEAR_SWITCHES)
+    return !digitalRead(gears[gear].pin);
+#elif (GEARINPUT == GEAR_SENSOR)
+    return (gear == sensorGear);
+#endif
 }
 
 /*
@@ -332,7 +1020,7 @@ void drawGearInfo(int16_t gear)
 */
 int16_t gearChanged(int16_t gear, int16_t lastGear)
 {
-    if(!digitalRead(gears[gear].pin) && (gears[gear].pin != lastGear))
+    if(gearActive(gear) && (gears[gear].pin != lastGear))
     {
         if(firstRun)
         {
@@ -360,13 +1048,55 @@ float measureT(void)
 #define CALOFFSET   4.0
     float retVal;
 
+    //The library waits for the conversion in between its transfers, so that
+    //wait is counted as bus time as well
+    ENERGY(ENERGY_ADC, true);
+    ENERGY(ENERGY_BUS, true);
     retVal = (adc.readADC_SingleEnded(0)*CALVALUE)/32767.0;
+    ENERGY(ENERGY_BUS, false);
+    ENERGY(ENERGY_ADC, false);
 
     retVal /= 0.01;
     retVal -= (273.15 + CALOFFSET);
 
     return retVal;
 }
+
+#ifdef _ENERGYMETER_
+/*
+**------------------------------------------------------------------------------
+** printEnergy:
+**
+** Prints the time on/off and the estimated charge of each part, and the
+** average draw in mAh per hour
+**------------------------------------------------------------------------------
+*/
+void printEnergy(void)
+{
+    static const char* const names[ENERGY_DOMAINS] = { "panel", "mcu", "adc", "i2c" };
+    float total = 0;
+    uint8_t i;
+
+    energyUpdate(micros());
+
+    for(i = 0 ; i < ENERGY_DOMAINS ; i++)
+    {
+        Serial.print(names[i]);
+        Serial.print(F(" on s: "));
+        Serial.print(energySeconds(i, true));
+        Serial.print(F(" off s: "));
+        Serial.print(energySeconds(i, false));
+        Serial.print(F(" mAh: "));
+        Serial.println(energyCharge(i), 4);
+        total += energyCharge(i);
+    }
+    Serial.print(F("total mAh: "));
+    Serial.print(total, 4);
+    Serial.print(F(" mAh/h: "));
+    Serial.println(total * 3600.0 / energyElapsed(), 2);
+}
+#endif
+
 /*
 **------------------------------------------------------------------------------
 ** loop:
@@ -381,12 +1111,28 @@ void loop(void)
     static uint16_t sleepTimer = 0;
     static uint16_t sampleTimer = 0;
     static int sensorValue = 0;
+#ifdef _RPMINPUT_
+    static uint16_t rpmTimer = 0;
+#endif
+    uint16_t i;
+
+#if (GEARINPUT == GEAR_SENSOR)
+    //The sensor tells which gear it is, no need to scan for it
+    sensorGear = classifyGear(readGearSensor());
+    if(sensorGear >= 0)
+    {
+        checkGear = sensorGear;
+    }
+#endif
 
     if(gearChanged(checkGear, lastGear))
     {
         lastGear = gears[checkGear].pin;
 
-        wakeDisplay(&display);
+        for(i = 0 ; i < PANEL_COUNT ; i++)
+        {
+            wakeDisplay(panels[i].display);
+        }
         sleepTimer = 0;
         drawGearInfo(checkGear);
     }
@@ -404,7 +1150,10 @@ void loop(void)
     else if(sleepTimer == SLEEPDELAY)
     {
         sleepTimer++;
-        sleepDisplay(&display);
+        for(i = 0 ; i < PANEL_COUNT ; i++)
+        {
+            sleepDisplay(panels[i].display);
+        }
     }
 
     #ifdef _THERMOMETER_
@@ -412,9 +1161,45 @@ void loop(void)
     {
         sampleTimer = 0;
         temperature = measureT();
+        #if (GEARINPUT == GEAR_SENSOR)
+        startGearSensor();
+        #endif
         drawTemperature();
-        display.display();
+        markDirty(MAIN_PANEL);
+        #if defined(_SECOND_DISPLAY_) && (SECOND_MODE == SECOND_STATS)
+        drawStats();
+        #endif
     }
     #endif
+
+    #ifdef _RPMINPUT_
+    if(rpmTimer++ >= RPMFRAMEDELAY)
+    {
+        rpmTimer = 0;
+        rpm = rpmRead(millis());
+        if(sleepTimer <= SLEEPDELAY)
+        {
+            updateRpm();
+        }
+    }
+    #endif
+
+    flushPanels();
+
+    #ifdef _SERIALMIRROR_
+    mirrorService(display.getBuffer());
+    #endif
+
+    #ifdef _ENERGYMETER_
+    //Spans are 32 bit micros(), so they have to be added up well before it wraps
+    energyUpdate(micros());
+    if(Serial.available() && (Serial.read() == 'e'))
+    {
+        printEnergy();
+    }
+    #endif
+
+    ENERGY(ENERGY_MCU, false);
     delay(10);
+    ENERGY(ENERGY_MCU, true);
 }
@@ -0,0 +1,315 @@
+/*
+**------------------------------------------------------------------------------
+** Mirror:
+**
+** Sends the SSD1306 pages that changed since the last frame over Serial,
+** RLE compressed. Frames go through a TX queue that is drained a little on
+** every call, so the stream never holds up the display or the gear scanning.
+**
+** Frame layout:
+**   0xa5 0x5a      sync
+**   seq            frame sequence number, wraps
+**   mask           bit n set if page n follows
+**   len            payload length, 16 bit little endian
+**   payload        the pages in mask order, each RLE coded to SCREEN_WIDTH bytes
+**   sum            8 bit sum of seq through payload
+**
+** RLE control byte c: c < 0x80 is followed by c + 1 literal bytes, otherwise
+** the next byte is repeated c - 0x80 + 2 times.
+**
+** Every MIRROR_KEYFRAME frame checks all pages are sent, changed or not, so a
+** viewer that joined late or lost a frame catches up even on an idle panel.
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** References
+**------------------------------------------------------------------------------
+*/
+#include <Arduino.h>
+#include <stdint.h>
+#include <config.h>
+#include <mirror.h>
+
+#ifdef _SERIALMIRROR_
+
+/*
+**------------------------------------------------------------------------------
+** Constants
+**------------------------------------------------------------------------------
+*/
+#define PAGES               (SCREEN_HEIGHT / 8)
+#define QUEUESIZE           256U        // power of two, fits at least one page
+#define HEADERSIZE          7U
+#define RUNMIN              3U
+#define RUNMAX              129U
+#define LITERALMAX          128U
+//The nRF5 Uart has no TX buffer and waits for every byte, so only a couple of
+//bytes (about 2 ms at 19200 baud) are written per call there
+#define TXBURST             4U
+
+/*
+**------------------------------------------------------------------------------
+** Locals
+**------------------------------------------------------------------------------
+*/
+static uint8_t queue[QUEUESIZE];
+static uint16_t head = 0;
+static uint16_t tail = 0;
+static uint16_t pageSums[PAGES];
+static uint8_t stale = 0xff;
+static uint8_t seq = 0;
+static uint8_t keyCounter = 0;
+
+/*
+**------------------------------------------------------------------------------
+** Functions
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** queueFree:
+**
+** See name
+**------------------------------------------------------------------------------
+*/
+static uint16_t queueFree(void)
+{
+    return QUEUESIZE - 1 - ((head - tail) & (QUEUESIZE - 1));
+}
+
+/*
+**------------------------------------------------------------------------------
+** queuePut:
+**
+** Adds a byte to the TX queue and to the running frame sum
+**------------------------------------------------------------------------------
+*/
+static void queuePut(uint8_t b, uint8_t* sum)
+{
+    queue[head] = b;
+    head = (head + 1) & (QUEUESIZE - 1);
+    *sum += b;
+}
+
+/*
+**------------------------------------------------------------------------------
+** pageSum:
+**
+** Fletcher-16 of a page, used to tell if it changed since it was last sent.
+** The sums are wide enough for a whole page, so they are only reduced mod 255
+** once at the end.
+**------------------------------------------------------------------------------
+*/
+static uint16_t pageSum(const uint8_t* page)
+{
+    uint16_t a = 0;
+    uint32_t b = 0;
+    uint16_t i;
+
+    for(i = 0 ; i < SCREEN_WIDTH ; i++)
+    {
+        a += page[i];
+        b += a;
+    }
+    return ((uint16_t)(b % 255) << 8) | (a % 255);
+}
+
+/*
+**------------------------------------------------------------------------------
+** encodeLiteral:
+**
+** Codes the count bytes before end as literals
+**------------------------------------------------------------------------------
+*/
+static uint16_t encodeLiteral(const uint8_t* end, uint16_t count, uint8_t emit, uint8_t* sum)
+{
+    uint16_t i;
+
+    if(!count)
+    {
+        return 0;
+    }
+    if(emit)
+    {
+        queuePut(count - 1, sum);
+        for(i = count ; i > 0 ; i--)
+        {
+            queuePut(*(end - i), sum);
+        }
+    }
+    return 1 + count;
+}
+
+/*
+**------------------------------------------------------------------------------
+** encodePage:
+**
+** RLE codes a page. Only counts the output if emit is false, so the frame
+** size is known before anything is queued.
+**------------------------------------------------------------------------------
+*/
+static uint16_t encodePage(const uint8_t* page, uint8_t emit, uint8_t* sum)
+{
+    uint16_t size = 0;
+    uint16_t i = 0;
+    uint16_t literal = 0;
+    uint16_t run;
+
+    while(i < SCREEN_WIDTH)
+    {
+        run = 1;
+        while((i + run < SCREEN_WIDTH) && (run < RUNMAX) && (page[i + run] == page[i]))
+        {
+            run++;
+        }
+
+        if(run >= RUNMIN)
+        {
+            size += encodeLiteral(&page[i], literal, emit, sum);
+            literal = 0;
+            if(emit)
+            {
+                queuePut(0x80 + run - 2, sum);
+                queuePut(page[i], sum);
+            }
+            size += 2;
+            i += run;
+        }
+        else
+        {
+            literal++;
+            i++;
+            if(literal >= LITERALMAX)
+            {
+                size += encodeLiteral(&page[i], literal, emit, sum);
+                literal = 0;
+            }
+        }
+    }
+    size += encodeLiteral(&page[i], literal, emit, sum);
+
+    return size;
+}
+
+/*
+**------------------------------------------------------------------------------
+** queueFrame:
+**
+** Queues the pages that changed, or all of them every MIRROR_KEYFRAME calls,
+** as many as there is room for. Pages that
+** don't fit stay changed and go out with the next frame.
+**------------------------------------------------------------------------------
+*/
+static void queueFrame(const uint8_t* buffer)
+{
+    uint16_t sums[PAGES];
+    uint16_t sizes[PAGES];
+    uint16_t room = queueFree();
+    uint16_t len = 0;
+    uint8_t mask = 0;
+    uint8_t sum = 0;
+    uint8_t page;
+
+    //Counted per check, not per frame sent, so an idle panel gets them too
+    if(keyCounter == 0)
+    {
+        stale = 0xff;
+    }
+    keyCounter++;
+    if(keyCounter >= MIRROR_KEYFRAME)
+    {
+        keyCounter = 0;
+    }
+
+    if(room <= HEADERSIZE)
+    {
+        return;
+    }
+    room -= HEADERSIZE;
+
+    for(page = 0 ; page < PAGES ; page++)
+    {
+        sums[page] = pageSum(&buffer[page * SCREEN_WIDTH]);
+        if(!(stale & (1 << page)) && (sums[page] == pageSums[page]))
+        {
+            continue;
+        }
+
+        sizes[page] = encodePage(&buffer[page * SCREEN_WIDTH], false, &sum);
+        if(len + sizes[page] <= room)
+        {
+            mask |= (1 << page);
+            len += sizes[page];
+        }
+    }
+
+    if(!mask)
+    {
+        return;
+    }
+
+    queuePut(0xa5, &sum);
+    queuePut(0x5a, &sum);
+    sum = 0;
+    queuePut(seq, &sum);
+    queuePut(mask, &sum);
+    queuePut(len & 0xff, &sum);
+    queuePut(len >> 8, &sum);
+    for(page = 0 ; page < PAGES ; page++)
+    {
+        if(mask & (1 << page))
+        {
+            encodePage(&buffer[page * SCREEN_WIDTH], true, &sum);
+            pageSums[page] = sums[page];
+            stale &= ~(1 << page);
+        }
+    }
+    queuePut(sum, &sum);
+
+    seq++;
+}
+
+/*
+**------------------------------------------------------------------------------
+** txRoom:
+**
+** How many bytes can be written without Serial blocking
+**------------------------------------------------------------------------------
+*/
+static uint16_t txRoom(void)
+{
+#if defined(__AVR__)
+    return Serial.availableForWrite();
+#else
+    return TXBURST;
+#endif
+}
+
+/*
+**------------------------------------------------------------------------------
+** mirrorService:
+**
+** Call once per loop pass. Checks the buffer for changes every MIRRORDELAY
+** calls and drains the TX queue as far as Serial allows.
+**------------------------------------------------------------------------------
+*/
+void mirrorService(const uint8_t* buffer)
+{
+    static uint16_t frameTimer = 0;
+    uint16_t n;
+
+    if(frameTimer++ >= MIRRORDELAY)
+    {
+        frameTimer = 0;
+        queueFrame(buffer);
+    }
+
+    for(n = txRoom() ; n && (tail != head) ; n--)
+    {
+        Serial.write(queue[tail]);
+        tail = (tail + 1) & (QUEUESIZE - 1);
+    }
+}
+
+#endif
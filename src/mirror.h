@@ -0,0 +1,14 @@
+/*
+**------------------------------------------------------------------------------
+** Delta compressed frame buffer mirroring over Serial
+**------------------------------------------------------------------------------
+*/
+
+#ifndef _MIRROR_H_
+#define _MIRROR_H_
+
+#include <stdint.h>
+
+void mirrorService(const uint8_t* buffer);
+
+#endif
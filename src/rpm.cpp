@@ -0,0 +1,252 @@
+/*
+**------------------------------------------------------------------------------
+** RPM:
+**
+** Measures the period between ignition/tach pulses with a hardware timer
+** capture, so no CPU time is spent polling the input.
+**
+** ATmega328P: Timer1 input capture on ICP1 (D8), extended to 32 bits with the
+**             overflow interrupt.
+** nRF52:      GPIOTE event on RPM_PIN captures the free running TIMER2 through
+**             PPI, and counts TIMER3 which interrupts once per pulse.
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** References
+**------------------------------------------------------------------------------
+*/
+#include <Arduino.h>
+#include <stdint.h>
+#include <config.h>
+#include <rpm.h>
+
+#ifdef _RPMINPUT_
+
+/*
+**------------------------------------------------------------------------------
+** Constants
+**------------------------------------------------------------------------------
+*/
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__)
+#define RPM_TIMER_HZ        (F_CPU / 8)
+#elif defined(NRF52)
+#define RPM_TIMER_HZ        1000000UL
+#define RPM_GPIOTE_CH       7           // attachInterrupt() allocates from 0
+#define RPM_PPI_CH          8
+#elif !defined(ARDUINO)
+//Host builds, tools/rpmsim.cpp calls rpmPulse() itself
+#define RPM_TIMER_HZ        1000000UL
+#else
+#error "_RPMINPUT_ has no timer capture support for this MCU"
+#endif
+
+#define RPM_MIN_PERIOD      ((60UL * RPM_TIMER_HZ) / ((uint32_t)RPM_LIMIT * PULSES_PER_REV))
+#define RPM_TIMEOUT         500U        // ms without pulses before reading 0
+
+/*
+**------------------------------------------------------------------------------
+** Locals
+**------------------------------------------------------------------------------
+*/
+static volatile uint32_t periods[RPM_AVERAGE];
+static volatile uint32_t periodSum = 0;
+static volatile uint8_t periodIndex = 0;
+static volatile uint8_t periodCount = 0;
+static volatile uint32_t lastStamp = 0;
+static volatile uint32_t lastPulseMs = 0;
+static volatile uint8_t havePulse = false;
+#if defined(__AVR__)
+static volatile uint16_t overflows = 0;
+#endif
+
+/*
+**------------------------------------------------------------------------------
+** Functions
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** rpmPulse:
+**
+** Called from the capture interrupt with the timer value of a pulse and the
+** time in ms. Keeps a running sum of the last RPM_AVERAGE periods.
+**------------------------------------------------------------------------------
+*/
+void rpmPulse(uint32_t stamp, uint32_t now)
+{
+    uint32_t period = stamp - lastStamp;
+
+    if(!havePulse)
+    {
+        havePulse = true;
+        lastStamp = stamp;
+        lastPulseMs = now;
+        return;
+    }
+
+    //Ignition noise, wait for the real edge
+    if(period < RPM_MIN_PERIOD)
+    {
+        return;
+    }
+    lastStamp = stamp;
+    lastPulseMs = now;
+
+    periodSum -= periods[periodIndex];
+    periods[periodIndex] = period;
+    periodSum += period;
+    periodIndex++;
+    if(periodIndex >= RPM_AVERAGE)
+    {
+        periodIndex = 0;
+    }
+    if(periodCount < RPM_AVERAGE)
+    {
+        periodCount++;
+    }
+}
+
+/*
+**------------------------------------------------------------------------------
+** rpmRead:
+**
+** Returns the averaged RPM at time now (ms), or 0 if the engine has stopped
+**------------------------------------------------------------------------------
+*/
+uint16_t rpmRead(uint32_t now)
+{
+    uint32_t sum;
+    uint8_t count;
+    uint32_t pulseMs;
+    uint8_t pulse;
+    uint8_t i;
+
+    noInterrupts();
+    sum = periodSum;
+    count = periodCount;
+    pulseMs = lastPulseMs;
+    pulse = havePulse;
+    interrupts();
+
+    if(pulse && ((now - pulseMs) > RPM_TIMEOUT))
+    {
+        //Start over so a stale period isn't averaged into the next reading
+        noInterrupts();
+        for(i = 0 ; i < RPM_AVERAGE ; i++)
+        {
+            periods[i] = 0;
+        }
+        periodSum = 0;
+        periodCount = 0;
+        havePulse = false;
+        interrupts();
+        return 0;
+    }
+
+    //Waiting for the second pulse
+    if(count == 0)
+    {
+        return 0;
+    }
+
+    return (uint16_t)(((60UL * RPM_TIMER_HZ) / PULSES_PER_REV) / (sum / count));
+}
+
+#if defined(__AVR__)
+/*
+**------------------------------------------------------------------------------
+** rpmBegin:
+**
+** Timer1 at F_CPU/8, capture on the falling edge with the noise canceler on
+**------------------------------------------------------------------------------
+*/
+void rpmBegin(void)
+{
+    pinMode(8, INPUT_PULLUP);
+
+    noInterrupts();
+    TCCR1A = 0;
+    TCCR1B = _BV(ICNC1) | _BV(CS11);
+    TCNT1 = 0;
+    TIFR1 = _BV(ICF1) | _BV(TOV1);
+    TIMSK1 = _BV(ICIE1) | _BV(TOIE1);
+    interrupts();
+}
+
+ISR(TIMER1_OVF_vect)
+{
+    overflows++;
+}
+
+ISR(TIMER1_CAPT_vect)
+{
+    uint16_t icr = ICR1;
+    uint16_t ovf = overflows;
+
+    //The overflow is still pending if it happened just before the capture
+    if((TIFR1 & _BV(TOV1)) && (icr < 0x8000))
+    {
+        ovf++;
+    }
+    rpmPulse(((uint32_t)ovf << 16) | icr, millis());
+}
+
+#elif defined(NRF52)
+/*
+**------------------------------------------------------------------------------
+** rpmBegin:
+**
+** TIMER2 free runs at 1 MHz, 32 bit. Each falling edge on RPM_PIN captures it
+** into CC[0] and counts TIMER3, which interrupts on every count.
+**------------------------------------------------------------------------------
+*/
+void rpmBegin(void)
+{
+    pinMode(RPM_PIN, INPUT_PULLUP);
+
+    NRF_TIMER2->TASKS_STOP = 1;
+    NRF_TIMER2->MODE = TIMER_MODE_MODE_Timer;
+    NRF_TIMER2->BITMODE = TIMER_BITMODE_BITMODE_32Bit;
+    NRF_TIMER2->PRESCALER = 4;                  // 16 MHz / 2^4
+    NRF_TIMER2->TASKS_CLEAR = 1;
+
+    NRF_TIMER3->TASKS_STOP = 1;
+    NRF_TIMER3->MODE = TIMER_MODE_MODE_Counter;
+    NRF_TIMER3->BITMODE = TIMER_BITMODE_BITMODE_16Bit;
+    NRF_TIMER3->CC[0] = 1;
+    NRF_TIMER3->SHORTS = TIMER_SHORTS_COMPARE0_CLEAR_Msk;
+    NRF_TIMER3->TASKS_CLEAR = 1;
+    NRF_TIMER3->EVENTS_COMPARE[0] = 0;
+    NRF_TIMER3->INTENSET = TIMER_INTENSET_COMPARE0_Msk;
+
+    NRF_GPIOTE->CONFIG[RPM_GPIOTE_CH] =
+        (GPIOTE_CONFIG_MODE_Event << GPIOTE_CONFIG_MODE_Pos) |
+        (g_ADigitalPinMap[RPM_PIN] << GPIOTE_CONFIG_PSEL_Pos) |
+        (GPIOTE_CONFIG_POLARITY_HiToLo << GPIOTE_CONFIG_POLARITY_Pos);
+    NRF_GPIOTE->EVENTS_IN[RPM_GPIOTE_CH] = 0;
+
+    NRF_PPI->CH[RPM_PPI_CH].EEP = (uint32_t)&NRF_GPIOTE->EVENTS_IN[RPM_GPIOTE_CH];
+    NRF_PPI->CH[RPM_PPI_CH].TEP = (uint32_t)&NRF_TIMER2->TASKS_CAPTURE[0];
+    NRF_PPI->FORK[RPM_PPI_CH].TEP = (uint32_t)&NRF_TIMER3->TASKS_COUNT;
+    NRF_PPI->CHENSET = (1UL << RPM_PPI_CH);
+
+    NVIC_SetPriority(TIMER3_IRQn, 3);
+    NVIC_ClearPendingIRQ(TIMER3_IRQn);
+    NVIC_EnableIRQ(TIMER3_IRQn);
+
+    NRF_TIMER2->TASKS_START = 1;
+    NRF_TIMER3->TASKS_START = 1;
+}
+
+extern "C" void TIMER3_IRQHandler(void)
+{
+    if(NRF_TIMER3->EVENTS_COMPARE[0])
+    {
+        NRF_TIMER3->EVENTS_COMPARE[0] = 0;
+        rpmPulse(NRF_TIMER2->CC[0], millis());
+    }
+}
+#endif
+
+#endif
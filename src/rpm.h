@@ -0,0 +1,16 @@
+/*
+**------------------------------------------------------------------------------
+** RPM measurement through hardware timer input capture
+**------------------------------------------------------------------------------
+*/
+
+#ifndef _RPM_H_
+#define _RPM_H_
+
+#include <stdint.h>
+
+void rpmBegin(void);
+void rpmPulse(uint32_t stamp, uint32_t now);
+uint16_t rpmRead(uint32_t now);
+
+#endif
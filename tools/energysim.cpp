@@ -0,0 +1,186 @@
+/*
+**------------------------------------------------------------------------------
+** energysim:
+**
+** Runs the energy accounting on the host with a virtual clock, following the
+** same schedule as loop(), to compare SLEEPDELAY/SAMPLEDELAY policies by
+** estimated mAh per hour of riding.
+**
+** g++ -D_ENERGYMETER_ -Isrc tools/energysim.cpp src/energy.cpp -o energysim
+** ./energysim [shift interval s] [SLEEPDELAY] [SAMPLEDELAY]
+**
+** Without SLEEPDELAY/SAMPLEDELAY a table of common settings is printed.
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** References
+**------------------------------------------------------------------------------
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <energy.h>
+
+/*
+**------------------------------------------------------------------------------
+** Constants
+**------------------------------------------------------------------------------
+*/
+#define RIDE_US             3600000000ULL   // one hour
+#define LOOP_DELAY_US       10000U          // delay(10)
+#define PASS_US             200U            // gear scan and bookkeeping
+#define FRAME_US            24000U          // 512 bytes at 200 kHz I2C
+#define CONVERSION_US       8000U           // readADC_SingleEnded() wait
+
+/*
+**------------------------------------------------------------------------------
+** Locals
+**------------------------------------------------------------------------------
+*/
+static uint32_t now = 0;
+static uint64_t total = 0;
+
+/*
+**------------------------------------------------------------------------------
+** Functions
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** advance:
+**
+** Moves the virtual clock
+**------------------------------------------------------------------------------
+*/
+static void advance(uint32_t us)
+{
+    now += us;
+    total += us;
+}
+
+/*
+**------------------------------------------------------------------------------
+** pushFrame:
+**
+** A full frame over I2C, the MCU waits for it
+**------------------------------------------------------------------------------
+*/
+static void pushFrame(void)
+{
+    energySet(ENERGY_BUS, true, now);
+    advance(FRAME_US);
+    energySet(ENERGY_BUS, false, now);
+}
+
+/*
+**------------------------------------------------------------------------------
+** ride:
+**
+** Simulates an hour with a gear change every shiftUs and returns mAh/h
+**------------------------------------------------------------------------------
+*/
+static float ride(uint64_t shiftUs, uint32_t sleepDelay, uint32_t sampleDelay)
+{
+    uint32_t sleepTimer = 0;
+    uint32_t sampleTimer = 0;
+    uint64_t nextShift = 0;
+    float charge = 0;
+    uint8_t i;
+
+    now = 0;
+    total = 0;
+    energyBegin(now, 1);
+
+    while(total < RIDE_US)
+    {
+        advance(PASS_US);
+
+        if(total >= nextShift)
+        {
+            nextShift += shiftUs;
+            energySet(ENERGY_PANEL, true, now);
+            sleepTimer = 0;
+            pushFrame();
+        }
+
+        if(sleepTimer < sleepDelay)
+        {
+            sleepTimer++;
+        }
+        else if(sleepTimer == sleepDelay)
+        {
+            sleepTimer++;
+            energySet(ENERGY_PANEL, false, now);
+        }
+
+        if(sampleTimer++ > sampleDelay)
+        {
+            sampleTimer = 0;
+            energySet(ENERGY_ADC, true, now);
+            advance(CONVERSION_US);
+            energySet(ENERGY_ADC, false, now);
+            pushFrame();
+        }
+
+        energyUpdate(now);
+        energySet(ENERGY_MCU, false, now);
+        advance(LOOP_DELAY_US);
+        energySet(ENERGY_MCU, true, now);
+    }
+
+    energyUpdate(now);
+    for(i = 0 ; i < ENERGY_DOMAINS ; i++)
+    {
+        charge += energyCharge(i);
+    }
+    return charge * 3600.0 / energyElapsed();
+}
+
+/*
+**------------------------------------------------------------------------------
+** main:
+**
+** See name
+**------------------------------------------------------------------------------
+*/
+int main(int argc, char** argv)
+{
+    static const uint32_t sleepDelays[] = { 100, 500, 1000, 3000 };
+    static const uint32_t sampleDelays[] = { 50, 100, 500 };
+    float shiftS = 6.0;
+    uint64_t shiftUs;
+    uint8_t i;
+    uint8_t j;
+
+    if(argc > 1)
+    {
+        shiftS = atof(argv[1]);
+    }
+    shiftUs = shiftS * 1e6;
+
+    if(argc > 3)
+    {
+        printf("%.2f mAh/h\n", ride(shiftUs, atoi(argv[2]), atoi(argv[3])));
+        return 0;
+    }
+
+    printf("gear change every %.1f s, mAh/h\n", shiftS);
+    printf("SLEEPDELAY ");
+    for(j = 0 ; j < sizeof(sampleDelays)/sizeof(uint32_t) ; j++)
+    {
+        printf(" SAMPLE %4u", (unsigned)sampleDelays[j]);
+    }
+    printf("\n");
+    for(i = 0 ; i < sizeof(sleepDelays)/sizeof(uint32_t) ; i++)
+    {
+        printf("%10u ", (unsigned)sleepDelays[i]);
+        for(j = 0 ; j < sizeof(sampleDelays)/sizeof(uint32_t) ; j++)
+        {
+            printf(" %11.2f", ride(shiftUs, sleepDelays[i], sampleDelays[j]));
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
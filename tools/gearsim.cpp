@@ -0,0 +1,233 @@
+/*
+**------------------------------------------------------------------------------
+** gearsim:
+**
+** Feeds src/gearsensor.cpp noisy synthetic gear position sensor traces, one
+** sample per loop pass, and reports the detection latency and how often a
+** wrong gear is reported. Latency is in ms at PASS_MS per loop pass, plus the
+** age of the ADS1115 conversion that was read, at most one 860 SPS period.
+**
+** Each shift ramps the voltage from the old band center to the new one over
+** RAMP samples and then holds it. Gaussian noise is added, with the odd spike,
+** and the result is quantized like the ADS1115 at 2/3 gain.
+**
+** g++ -Isrc tools/gearsim.cpp src/gearsensor.cpp -o gearsim
+** ./gearsim [noise mV]
+**
+** Without a noise level a table of common levels is printed.
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** References
+**------------------------------------------------------------------------------
+*/
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <gearsensor.h>
+
+/*
+**------------------------------------------------------------------------------
+** Constants
+**------------------------------------------------------------------------------
+*/
+#define RAMP                5U          // samples the sensor takes to move
+#define PASS_MS             10.0        // delay(10) in loop(), drawing not counted
+#define CONVERSION_MS       (1000.0 / 860.0)
+#define HOLD                100U        // samples a gear is held
+#define SPIKE_CHANCE        0.01        // per sample
+#define SPIKE_MV            500.0
+
+//Indexes into gearBands[]: 1 N 1 2 3 4 5 6 5 4 3 2 1 N
+static const uint8_t shifts[] = { 0, 1, 0, 2, 3, 4, 5, 6, 5, 4, 3, 2, 0, 1 };
+
+/*
+**------------------------------------------------------------------------------
+** Locals
+**------------------------------------------------------------------------------
+*/
+static uint32_t seed = 1;
+
+/*
+**------------------------------------------------------------------------------
+** Functions
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** uniform:
+**
+** Uniform in 0..1, repeatable between runs
+**------------------------------------------------------------------------------
+*/
+static double uniform(void)
+{
+    seed = seed * 1103515245UL + 12345UL;
+    return (((seed >> 8) & 0xffff) + 0.5) / 65536.0;
+}
+
+/*
+**------------------------------------------------------------------------------
+** gauss:
+**
+** Standard normal, Box-Muller
+**------------------------------------------------------------------------------
+*/
+static double gauss(void)
+{
+    return sqrt(-2.0 * log(uniform())) * cos(2.0 * M_PI * uniform());
+}
+
+/*
+**------------------------------------------------------------------------------
+** center:
+**
+** Nominal sensor voltage of a gear
+**------------------------------------------------------------------------------
+*/
+static double center(uint8_t gear)
+{
+    return (gearBands[gear].lo + gearBands[gear].hi) / 2.0;
+}
+
+/*
+**------------------------------------------------------------------------------
+** sample:
+**
+** Adds noise to a voltage and quantizes it like readGearSensor()
+**------------------------------------------------------------------------------
+*/
+static uint16_t sample(double mv, double noise)
+{
+    int32_t raw;
+
+    mv += gauss() * noise;
+    if(uniform() < SPIKE_CHANCE)
+    {
+        mv += (uniform() < 0.5) ? -SPIKE_MV : SPIKE_MV;
+    }
+
+    raw = (int32_t)(mv * 16.0 / 3.0);
+    if(raw < 0)
+    {
+        raw = 0;
+    }
+    if(raw > 32767)
+    {
+        raw = 32767;
+    }
+    return ((uint32_t)raw * 3) / 16;
+}
+
+/*
+**------------------------------------------------------------------------------
+** run:
+**
+** Runs the shift sequence a number of times at one noise level and prints
+** the results. The first shift only settles the classifier and isn't counted.
+**------------------------------------------------------------------------------
+*/
+static void run(double noise)
+{
+#define ROUNDS              20U
+    uint32_t samples = 0;
+    uint32_t wrong = 0;
+    uint32_t steps = 0;
+    uint32_t missed = 0;
+    uint32_t latencySum = 0;
+    uint32_t latencyMax = 0;
+    uint8_t prev = shifts[0];
+    uint8_t target;
+    uint8_t reached;
+    uint16_t round;
+    uint16_t k;
+    uint16_t s;
+    double mv;
+    int16_t gear;
+
+    for(s = 0 ; s < HOLD ; s++)
+    {
+        classifyGear(sample(center(prev), noise));
+    }
+
+    for(round = 0 ; round < ROUNDS ; round++)
+    {
+        for(k = 1 ; k < sizeof(shifts) ; k++)
+        {
+            target = shifts[k];
+            reached = false;
+
+            for(s = 0 ; s < RAMP + HOLD ; s++)
+            {
+                if(s < RAMP)
+                {
+                    mv = center(prev) + (center(target) - center(prev)) * (s + 1) / RAMP;
+                }
+                else
+                {
+                    mv = center(target);
+                }
+                gear = classifyGear(sample(mv, noise));
+
+                if(!reached && (gear == target))
+                {
+                    reached = true;
+                    latencySum += s + 1;
+                    if(s + 1 > (int)latencyMax)
+                    {
+                        latencyMax = s + 1;
+                    }
+                }
+                //Showing the old gear until the new one is detected is fine
+                if((gear != target) && (reached || (gear != prev)))
+                {
+                    wrong++;
+                }
+                samples++;
+            }
+
+            if(!reached)
+            {
+                missed++;
+            }
+            steps++;
+            prev = target;
+        }
+    }
+
+    printf("%8.0f %14.1f %14.1f %17.3f %7u\n", noise,
+           (steps > missed) ? (double)latencySum * PASS_MS / (steps - missed) + CONVERSION_MS : 0.0,
+           latencyMax * PASS_MS + CONVERSION_MS, 100.0 * wrong / samples, (unsigned)missed);
+}
+
+/*
+**------------------------------------------------------------------------------
+** main:
+**
+** See name
+**------------------------------------------------------------------------------
+*/
+int main(int argc, char** argv)
+{
+    static const double noises[] = { 0, 20, 40, 80, 120, 160 };
+    uint8_t i;
+
+    printf("latency in ms from the start of a %.0f ms shift, one sample per %.0f ms pass\n",
+           RAMP * PASS_MS, PASS_MS);
+    printf("noise mV avg latency ms max latency ms wrong samples %%  missed\n");
+
+    if(argc > 1)
+    {
+        run(atof(argv[1]));
+        return 0;
+    }
+
+    for(i = 0 ; i < sizeof(noises)/sizeof(double) ; i++)
+    {
+        run(noises[i]);
+    }
+
+    return 0;
+}
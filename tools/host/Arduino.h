@@ -0,0 +1,34 @@
+/*
+**------------------------------------------------------------------------------
+** Just enough of Arduino.h to build the hardware independent parts of the
+** firmware on a PC, for the simulators in tools/
+**------------------------------------------------------------------------------
+*/
+
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define PROGMEM
+
+static inline void noInterrupts(void) {}
+static inline void interrupts(void) {}
+
+//Serial only writes, to the stream the simulator picks
+class HostSerial
+{
+public:
+    FILE* out;
+
+    size_t write(uint8_t b)
+    {
+        return (fputc(b, out) == EOF) ? 0 : 1;
+    }
+};
+
+extern HostSerial Serial;   // defined by the simulators that use it
+
+#endif
@@ -0,0 +1,323 @@
+/*
+**------------------------------------------------------------------------------
+** mirrorsim:
+**
+** Runs src/mirror.cpp on a PC, one mirrorService() call per loop pass, and
+** writes the stream it sends to stdout, to be read with mirrorview.py.
+**
+** The main panel is drawn with the landscape layout of main.cpp: arrows,
+** gear, session counter and temperature. The gear uses the built in font at
+** 4x instead of FreeSansBold24pt7b, so the gear pages come out a little
+** different from the real ones, but about the same size.
+**
+** g++ -D_SERIALMIRROR_ -Itools/host -Isrc tools/mirrorsim.cpp src/mirror.cpp -o mirrorsim
+** ./mirrorsim gear > gear.bin && tools/mirrorview.py --quiet gear.bin
+** ./mirrorsim temp > temp.bin && tools/mirrorview.py --quiet temp.bin
+**
+** gear shifts every SHIFT_PASSES with a steady temperature, temp holds the
+** gear and lets the temperature climb 0.1 degrees per sample.
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** References
+**------------------------------------------------------------------------------
+*/
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <config.h>
+#include <bitmaps.h>
+#include <mirror.h>
+
+/*
+**------------------------------------------------------------------------------
+** Constants
+**------------------------------------------------------------------------------
+*/
+#define PASSES              4200U       // 42 s of 10 ms loop passes
+#define SHIFT_PASSES        300U
+#define SAMPLEDELAY         100U        // as in main.cpp
+#define GEAR_SCALE          4
+
+//Same layout as main.cpp in landscape with the counter and thermometer
+#define BASE_Y              26
+#define COUNTER_X           26
+#define COUNTER_Y           10
+#define TEMP_X              20
+#define TEMP_Y              20
+#define DEG_X               51
+#define DEG_Y               (TEMP_Y - 2)
+#define UP_X                100
+#define UP_Y                (32 - 33)
+#define DN_X                100
+#define DN_Y                (32 - 15)
+
+//Indexes into gears[]: 1 N 1 2 3 4 5 6 5 4 3 2 1 N
+static const uint8_t shifts[] = { 0, 1, 0, 2, 3, 4, 5, 6, 5, 4, 3, 2, 0, 1 };
+
+static const struct
+{
+    char name;
+    int16_t xOffset;
+} gears[] =
+{
+    { '1', 64 }, { 'N', 60 }, { '2', 64 }, { '3', 64 },
+    { '4', 64 }, { '5', 64 }, { '6', 64 }
+};
+
+//The glyphs of the Adafruit GFX built in font that the panel shows, one byte
+//per column with the top row in bit 0
+static const struct
+{
+    char c;
+    uint8_t columns[5];
+} font[] =
+{
+    { ' ', { 0x00, 0x00, 0x00, 0x00, 0x00 } },
+    { '.', { 0x00, 0x60, 0x60, 0x00, 0x00 } },
+    { '0', { 0x3e, 0x51, 0x49, 0x45, 0x3e } },
+    { '1', { 0x00, 0x42, 0x7f, 0x40, 0x00 } },
+    { '2', { 0x72, 0x49, 0x49, 0x49, 0x46 } },
+    { '3', { 0x21, 0x41, 0x49, 0x4d, 0x33 } },
+    { '4', { 0x18, 0x14, 0x12, 0x7f, 0x10 } },
+    { '5', { 0x27, 0x45, 0x45, 0x45, 0x39 } },
+    { '6', { 0x3c, 0x4a, 0x49, 0x49, 0x31 } },
+    { '7', { 0x41, 0x21, 0x11, 0x09, 0x07 } },
+    { '8', { 0x36, 0x49, 0x49, 0x49, 0x36 } },
+    { '9', { 0x46, 0x49, 0x49, 0x29, 0x1e } },
+    { 'N', { 0x7f, 0x04, 0x08, 0x10, 0x7f } }
+};
+
+/*
+**------------------------------------------------------------------------------
+** Locals
+**------------------------------------------------------------------------------
+*/
+HostSerial Serial;
+
+static uint8_t buffer[SCREEN_WIDTH * SCREEN_HEIGHT / 8];
+static uint32_t changeCounter = 0;
+static int16_t temperature = 215;       // 0.1 degrees
+
+/*
+**------------------------------------------------------------------------------
+** Functions
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** pixel:
+**
+** Sets or clears a pixel, SSD1306 page layout, clipped like Adafruit_SSD1306
+**------------------------------------------------------------------------------
+*/
+static void pixel(int16_t x, int16_t y, uint8_t on)
+{
+    if((x < 0) || (x >= SCREEN_WIDTH) || (y < 0) || (y >= SCREEN_HEIGHT))
+    {
+        return;
+    }
+    if(on)
+    {
+        buffer[x + (y / 8) * SCREEN_WIDTH] |= (1 << (y & 7));
+    }
+    else
+    {
+        buffer[x + (y / 8) * SCREEN_WIDTH] &= ~(1 << (y & 7));
+    }
+}
+
+/*
+**------------------------------------------------------------------------------
+** fillRect:
+**
+** See name
+**------------------------------------------------------------------------------
+*/
+static void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t on)
+{
+    int16_t i;
+    int16_t j;
+
+    for(j = y ; j < y + h ; j++)
+    {
+        for(i = x ; i < x + w ; i++)
+        {
+            pixel(i, j, on);
+        }
+    }
+}
+
+/*
+**------------------------------------------------------------------------------
+** drawBitmap:
+**
+** Rows of MSB first bytes, like Adafruit_GFX::drawBitmap()
+**------------------------------------------------------------------------------
+*/
+static void drawBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h)
+{
+    int16_t stride = (w + 7) / 8;
+    int16_t i;
+    int16_t j;
+
+    for(j = 0 ; j < h ; j++)
+    {
+        for(i = 0 ; i < w ; i++)
+        {
+            if(bitmap[j * stride + i / 8] & (0x80 >> (i & 7)))
+            {
+                pixel(x + i, y + j, true);
+            }
+        }
+    }
+}
+
+/*
+**------------------------------------------------------------------------------
+** print:
+**
+** Prints with the built in font, scaled, top left corner at x, y
+**------------------------------------------------------------------------------
+*/
+static void print(int16_t x, int16_t y, const char* str, uint8_t scale)
+{
+    uint8_t g;
+    uint8_t col;
+    uint8_t row;
+
+    for( ; *str ; str++, x += 6 * scale)
+    {
+        for(g = 0 ; (g < sizeof(font)/sizeof(font[0])) && (font[g].c != *str) ; g++);
+        if(g == sizeof(font)/sizeof(font[0]))
+        {
+            continue;
+        }
+        for(col = 0 ; col < 5 ; col++)
+        {
+            for(row = 0 ; row < 8 ; row++)
+            {
+                if(font[g].columns[col] & (1 << row))
+                {
+                    fillRect(x + col * scale, y + row * scale, scale, scale, true);
+                }
+            }
+        }
+    }
+}
+
+/*
+**------------------------------------------------------------------------------
+** drawTemperature:
+**
+** See main.cpp
+**------------------------------------------------------------------------------
+*/
+static void drawTemperature(void)
+{
+    char str[12];
+    int16_t t = temperature / 10;
+    uint16_t dec = temperature % 10;
+
+    fillRect(0, TEMP_Y - 4, 57, SCREEN_HEIGHT - TEMP_Y, false);
+    drawBitmap(DEG_X, DEG_Y, degIcon, DEGICON_WIDTH, DEGICON_HEIGHT);
+    fillRect(0, TEMP_Y - 5, 59, 1, true);
+    fillRect(58, 0, 1, SCREEN_HEIGHT, true);
+
+    sprintf(str, "% 2d.%1u", t, dec);
+    print(TEMP_X, TEMP_Y, str, 1);
+}
+
+/*
+**------------------------------------------------------------------------------
+** drawGearInfo:
+**
+** See main.cpp
+**------------------------------------------------------------------------------
+*/
+static void drawGearInfo(uint8_t gear)
+{
+    char str[12];
+
+    memset(buffer, 0, sizeof(buffer));
+
+    if(gear != sizeof(gears)/sizeof(gears[0]) - 1)
+    {
+        drawBitmap(UP_X, UP_Y, upIcon, ARROWICON_WIDTH, ARROWICON_HEIGHT);
+    }
+    if(gear != 0)
+    {
+        drawBitmap(DN_X, DN_Y, dnIcon, ARROWICON_WIDTH, ARROWICON_HEIGHT);
+    }
+
+    str[0] = gears[gear].name;
+    str[1] = '\0';
+    print(gears[gear].xOffset, BASE_Y - 7 * GEAR_SCALE, str, GEAR_SCALE);
+
+    fillRect(0, 15, 59, 1, true);
+    fillRect(58, 0, 1, SCREEN_HEIGHT, true);
+    sprintf(str, "%5lu", (unsigned long)(changeCounter % 100000UL));
+    print(COUNTER_X, COUNTER_Y, str, 1);
+
+    drawTemperature();
+}
+
+/*
+**------------------------------------------------------------------------------
+** main:
+**
+** See name
+**------------------------------------------------------------------------------
+*/
+int main(int argc, char** argv)
+{
+    uint8_t shiftGears = true;
+    uint16_t sampleTimer = 0;
+    uint8_t shift = 0;
+    uint8_t gear = 0;
+    uint32_t pass;
+
+    if(argc > 1)
+    {
+        if(!strcmp(argv[1], "temp"))
+        {
+            shiftGears = false;
+            gear = 2;
+        }
+        else if(strcmp(argv[1], "gear"))
+        {
+            fprintf(stderr, "usage: %s [gear|temp] > capture\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Serial.out = stdout;
+    drawGearInfo(gear);
+
+    for(pass = 1 ; pass <= PASSES ; pass++)
+    {
+        if(shiftGears && (pass % SHIFT_PASSES == 0))
+        {
+            shift = (shift + 1) % sizeof(shifts);
+            gear = shifts[shift];
+            changeCounter++;
+            drawGearInfo(gear);
+        }
+
+        if(sampleTimer++ > SAMPLEDELAY)
+        {
+            sampleTimer = 0;
+            if(!shiftGears)
+            {
+                temperature++;
+            }
+            drawTemperature();
+        }
+
+        mirrorService(buffer);
+    }
+
+    return 0;
+}
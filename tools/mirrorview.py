@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""
+Decoder/viewer for the frame buffer stream sent with _SERIALMIRROR_.
+
+Rebuilds the panel from the delta frames (see src/mirror.cpp for the format),
+draws it in the terminal and prints how many bytes each update took.
+
+    mirrorview.py --port /dev/ttyUSB0        (needs pyserial)
+    mirrorview.py capture.bin                (a raw capture of the stream)
+"""
+import argparse
+import sys
+
+WIDTH = 128
+HEIGHT = 32
+PAGES = HEIGHT // 8
+SYNC = b"\xa5\x5a"
+
+
+def decode_page(payload, pos):
+    """RLE decodes one page starting at pos, returns (bytes, new pos)."""
+    out = bytearray()
+    while len(out) < WIDTH:
+        if pos >= len(payload):
+            raise ValueError("page runs past the payload")
+        c = payload[pos]
+        pos += 1
+        if c < 0x80:
+            out += payload[pos:pos + c + 1]
+            pos += c + 1
+        else:
+            out += bytes([payload[pos]]) * (c - 0x80 + 2)
+            pos += 1
+    if len(out) != WIDTH:
+        raise ValueError("page decodes to %d bytes" % len(out))
+    return out, pos
+
+
+class Viewer:
+    def __init__(self, quiet):
+        self.quiet = quiet
+        self.buffer = bytearray(WIDTH * PAGES)
+        self.synced = 0         # pages known to be current
+        self.seq = None
+        self.frames = 0
+        self.total = 0
+        self.errors = 0
+
+    def frame(self, seq, mask, payload, size):
+        pos = 0
+        pages = {}
+        for page in range(PAGES):
+            if mask & (1 << page):
+                pages[page], pos = decode_page(payload, pos)
+        if pos != len(payload):
+            raise ValueError("trailing payload bytes")
+
+        if self.seq is not None and seq != (self.seq + 1) & 0xff:
+            print("lost %d frame(s), waiting for a full frame"
+                  % (((seq - self.seq - 1) & 0xff)), file=sys.stderr)
+            self.synced = 0
+        self.seq = seq
+
+        for page, data in pages.items():
+            self.buffer[page * WIDTH:(page + 1) * WIDTH] = data
+            self.synced |= 1 << page
+
+        self.frames += 1
+        self.total += size
+        print("frame %3d: %d page(s), %4d bytes, avg %.1f bytes/update%s"
+              % (seq, len(pages), size, self.total / self.frames,
+                 "" if self.synced == (1 << PAGES) - 1 else " (partial)"))
+        if not self.quiet:
+            self.draw()
+
+    def pixel(self, x, y):
+        return (self.buffer[x + (y // 8) * WIDTH] >> (y & 7)) & 1
+
+    def draw(self):
+        glyphs = " ▀▄█"
+        for y in range(0, HEIGHT, 2):
+            print("".join(glyphs[self.pixel(x, y) | (self.pixel(x, y + 1) << 1)]
+                          for x in range(WIDTH)))
+
+    def feed(self, data):
+        """Consumes as many complete frames from data as possible."""
+        while True:
+            start = data.find(SYNC)
+            if start < 0:
+                del data[:max(len(data) - 1, 0)]
+                return
+            del data[:start]
+            if len(data) < 6:
+                return
+            seq, mask = data[2], data[3]
+            length = data[4] | (data[5] << 8)
+            if length > PAGES * (WIDTH + 1):
+                self.errors += 1
+                del data[:1]
+                continue
+            if len(data) < 7 + length:
+                return
+            payload = bytes(data[6:6 + length])
+            if sum(data[2:6 + length]) & 0xff != data[6 + length]:
+                self.errors += 1
+                del data[:1]            # resync on the next sync pattern
+                continue
+            try:
+                self.frame(seq, mask, payload, 7 + length)
+            except ValueError as e:
+                self.errors += 1
+                print("bad frame: %s" % e, file=sys.stderr)
+                del data[:1]
+                continue
+            del data[:7 + length]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", nargs="?", help="raw capture file, - for stdin")
+    parser.add_argument("--port", help="serial port to read from")
+    parser.add_argument("--baud", type=int, default=19200)
+    parser.add_argument("--quiet", action="store_true", help="only print stats")
+    args = parser.parse_args()
+
+    viewer = Viewer(args.quiet)
+    data = bytearray()
+
+    if args.port:
+        import serial
+        port = serial.Serial(args.port, args.baud, timeout=0.1)
+        read = lambda: port.read(256)
+    elif args.capture and args.capture != "-":
+        f = open(args.capture, "rb")
+        read = lambda: f.read(4096)
+    else:
+        read = lambda: sys.stdin.buffer.read1(4096)
+
+    try:
+        while True:
+            chunk = read()
+            if not chunk and not args.port:
+                break
+            data += chunk
+            viewer.feed(data)
+    except KeyboardInterrupt:
+        pass
+
+    if viewer.frames:
+        print("%d frames, %d bytes, %.1f bytes/update, %d bad frames"
+              % (viewer.frames, viewer.total, viewer.total / viewer.frames, viewer.errors))
+
+
+if __name__ == "__main__":
+    main()
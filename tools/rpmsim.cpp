@@ -0,0 +1,162 @@
+/*
+**------------------------------------------------------------------------------
+** rpmsim:
+**
+** Feeds src/rpm.cpp a synthetic pulse train on a virtual clock and checks the
+** readings across the RPM range, the way loop() reads them every
+** RPMFRAMEDELAY + 1 passes. The pulses get some jitter and every tenth pulse
+** is followed by an ignition noise spike that has to be rejected.
+**
+** g++ -D_RPMINPUT_ -Itools/host -Isrc tools/rpmsim.cpp src/rpm.cpp -o rpmsim
+** ./rpmsim [jitter %]
+**
+** Exits with 1 if any speed reads more than TOLERANCE off after settling.
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** References
+**------------------------------------------------------------------------------
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <config.h>
+#include <rpm.h>
+
+/*
+**------------------------------------------------------------------------------
+** Constants
+**------------------------------------------------------------------------------
+*/
+#define TIMER_HZ            1000000UL   // matches the nRF52 capture timer
+#define RUN_US              3000000UL   // per speed
+#define SETTLE_US           500000UL    // readings before this are ignored
+#define READ_US             61000UL     // (RPMFRAMEDELAY + 1) loop passes
+#define SPIKE_US            50UL        // noise after every tenth pulse
+#define TOLERANCE           1.0         // %
+
+/*
+**------------------------------------------------------------------------------
+** Locals
+**------------------------------------------------------------------------------
+*/
+static uint32_t seed = 1;
+
+/*
+**------------------------------------------------------------------------------
+** Functions
+**------------------------------------------------------------------------------
+*/
+/*
+**------------------------------------------------------------------------------
+** jitter:
+**
+** Uniform in -1..1, repeatable between runs
+**------------------------------------------------------------------------------
+*/
+static double jitter(void)
+{
+    seed = seed * 1103515245UL + 12345UL;
+    return ((seed >> 8) & 0xffff) / 32767.5 - 1.0;
+}
+
+/*
+**------------------------------------------------------------------------------
+** run:
+**
+** Runs one speed, starting from a stopped engine, and returns the worst
+** error in % after settling. The clock starts at base so every run begins
+** well after the previous one timed out.
+**------------------------------------------------------------------------------
+*/
+static double run(uint32_t rpm, double jitterPct, uint64_t base, uint16_t* last)
+{
+    double period = (60.0 * TIMER_HZ) / ((double)rpm * PULSES_PER_REV);
+    double nextPulse = base;
+    uint64_t nextRead = base + READ_US;
+    uint64_t spike = 0;
+    uint64_t t;
+    uint32_t pulses = 0;
+    double worst = 0;
+    double err;
+    uint16_t reading;
+
+    for(t = base ; t < base + RUN_US ; t++)
+    {
+        if(t >= (uint64_t)nextPulse)
+        {
+            rpmPulse((uint32_t)t, (uint32_t)(t / 1000));
+            pulses++;
+            if(pulses % 10 == 0)
+            {
+                spike = t + SPIKE_US;
+            }
+            nextPulse += period * (1.0 + jitter() * jitterPct / 100.0);
+        }
+        if(spike && (t == spike))
+        {
+            rpmPulse((uint32_t)t, (uint32_t)(t / 1000));
+            spike = 0;
+        }
+        if(t == nextRead)
+        {
+            nextRead += READ_US;
+            reading = rpmRead((uint32_t)(t / 1000));
+            *last = reading;
+            if(t - base >= SETTLE_US)
+            {
+                err = 100.0 * ((double)reading - rpm) / rpm;
+                if(err < 0)
+                {
+                    err = -err;
+                }
+                if(err > worst)
+                {
+                    worst = err;
+                }
+            }
+        }
+    }
+
+    return worst;
+}
+
+/*
+**------------------------------------------------------------------------------
+** main:
+**
+** See name
+**------------------------------------------------------------------------------
+*/
+int main(int argc, char** argv)
+{
+    static const uint32_t speeds[] = { 300, 600, 800, 1000, 1500, 3000, 6000, 9000, 12000, 14000, 18000 };
+    double jitterPct = 0.5;
+    uint64_t base = 0;
+    uint16_t last;
+    double worst;
+    int failed = 0;
+    uint8_t i;
+
+    if(argc > 1)
+    {
+        jitterPct = atof(argv[1]);
+    }
+
+    printf("  rpm  read  worst error %%  (jitter %.1f %%)\n", jitterPct);
+    for(i = 0 ; i < sizeof(speeds)/sizeof(uint32_t) ; i++)
+    {
+        //Let the previous speed time out
+        base += RUN_US + 1000000UL;
+        worst = run(speeds[i], jitterPct, base, &last);
+        printf("%5u %5u %8.2f%s\n", (unsigned)speeds[i], last, worst,
+               (worst > TOLERANCE) ? "  FAIL" : "");
+        if(worst > TOLERANCE)
+        {
+            failed = 1;
+        }
+    }
+
+    return failed;
+}